@@ -0,0 +1,154 @@
+#include "cpuplacement.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+#define SYSFS_CPU "/sys/devices/system/cpu/"
+#define SYSFS_NODE "/sys/devices/system/node/"
+
+/**
+ * Parses the sysfs list format, e.g. "0-3,8-11"
+ */
+static std::vector<int> readCpuList(const std::string &path) {
+
+    std::vector<int> result;
+
+    std::ifstream file(path);
+
+    std::string line;
+
+    if (!file || !std::getline(file, line)) {
+        return result;
+    }
+
+    std::stringstream ranges(line);
+
+    std::string range;
+
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+
+        size_t dash = range.find('-');
+
+        int first = std::stoi(range.substr(0, dash)),
+                last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int cpu = first; cpu <= last; cpu++) {
+            result.push_back(cpu);
+        }
+    }
+
+    return result;
+}
+
+CpuTopology CpuTopology::detect() {
+
+    CpuTopology topology;
+
+    cpu_set_t allowed;
+
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return topology;
+    }
+
+    for (int cpu : readCpuList(SYSFS_CPU "online")) {
+        if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+            topology.cpus.push_back(cpu);
+        }
+    }
+
+    if (topology.cpus.empty()) {
+        return topology;
+    }
+
+    int maxCpu = *std::max_element(topology.cpus.begin(), topology.cpus.end());
+
+    topology.nodeOfCpu.assign(maxCpu + 1, 0);
+
+    topology.coreLeader.resize(maxCpu + 1);
+
+    //Without NUMA support in the kernel there is no node directory and everything is on node 0
+    std::vector<int> nodes = readCpuList(SYSFS_NODE "online");
+
+    topology.nodeCount = std::max(1, (int) nodes.size());
+
+    for (int i = 0; i < (int) nodes.size(); i++) {
+        for (int cpu : readCpuList(SYSFS_NODE "node" + std::to_string(nodes[i]) + "/cpulist")) {
+            if (cpu <= maxCpu) {
+                topology.nodeOfCpu[cpu] = i;
+            }
+        }
+    }
+
+    //The leader of a core is its first sibling we may run on, so a core is never skipped
+    //because its first hardware thread is outside the affinity mask
+    for (int cpu : topology.cpus) {
+        topology.coreLeader[cpu] = cpu;
+
+        for (int sibling : readCpuList(SYSFS_CPU "cpu" + std::to_string(cpu) + "/topology/thread_siblings_list")) {
+            if (sibling < CPU_SETSIZE && CPU_ISSET(sibling, &allowed)) {
+                topology.coreLeader[cpu] = sibling;
+
+                break;
+            }
+        }
+    }
+
+    return topology;
+}
+
+std::vector<int> CpuTopology::selectCpus(bool skipSMTSiblings) const {
+
+    std::vector<std::vector<int>> cpusPerNode(nodeCount);
+
+    for (int cpu : cpus) {
+        if (skipSMTSiblings && coreLeader[cpu] != cpu) {
+            continue;
+        }
+
+        cpusPerNode[nodeOfCpu[cpu]].push_back(cpu);
+    }
+
+    std::vector<int> result;
+
+    for (size_t i = 0; result.size() < cpus.size(); i++) {
+
+        bool added = false;
+
+        for (auto &nodeCpus : cpusPerNode) {
+            if (i < nodeCpus.size()) {
+                result.push_back(nodeCpus[i]);
+
+                added = true;
+            }
+        }
+
+        if (!added) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+int CpuTopology::getNodeOf(int cpu) const {
+    return cpu >= 0 && cpu < (int) nodeOfCpu.size() ? nodeOfCpu[cpu] : 0;
+}
+
+bool pinCurrentThread(int cpu) {
+
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
@@ -0,0 +1,56 @@
+#ifndef MADSIM_CPUPLACEMENT_H
+#define MADSIM_CPUPLACEMENT_H
+
+#include <vector>
+
+struct PlacementOptions {
+    //Pin each worker thread to its own CPU
+    bool pinThreads = false;
+
+    //Only use one hardware thread of each physical core
+    bool skipSMTSiblings = false;
+};
+
+/*
+ * The CPUs this process may run on and the NUMA node each of them belongs to,
+ * read from /sys/devices/system.
+ */
+class CpuTopology {
+
+public:
+    static CpuTopology detect();
+
+    /**
+     * The CPUs to pin the workers to, alternating between NUMA nodes so that
+     * the memory bandwidth of every node is used even with few workers.
+     *
+     * @param skipSMTSiblings Leave out every hardware thread but the first of each physical core
+     * @return Empty if the topology could not be read
+     */
+    std::vector<int> selectCpus(bool skipSMTSiblings) const;
+
+    int getNodeOf(int cpu) const;
+
+    int getNodeCount() const {
+        return nodeCount;
+    }
+
+private:
+    CpuTopology() : nodeCount(1) {}
+
+    std::vector<int> cpus;
+
+    //Indexed by CPU id
+    std::vector<int> nodeOfCpu, coreLeader;
+
+    int nodeCount;
+};
+
+/**
+ * Pins the calling thread to a single CPU.
+ *
+ * @return Whether the affinity could be set
+ */
+bool pinCurrentThread(int cpu);
+
+#endif //MADSIM_CPUPLACEMENT_H
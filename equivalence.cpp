@@ -0,0 +1,285 @@
+#include "equivalence.h"
+#include "simfuncs.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <boost/math/distributions/chi_squared.hpp>
+#include <boost/math/distributions/normal.hpp>
+
+//Least amount of observations, from both engines, in each bin of the chi-square test
+#define MIN_BIN_OBSERVATIONS 10
+
+std::vector<std::tuple<double, double, int>>
+referenceEngine(double compensation, double oc_probability, int observations, int dayCount, long seed) {
+
+    ObservationHolder holder(compensation, oc_probability, seed);
+
+    std::vector<std::tuple<double, double, int>> result(observations);
+
+    for (int i = 0; i < observations; i++) {
+        result[i] = holder.runObservation(dayCount);
+    }
+
+    return result;
+}
+
+template<typename T>
+static double mean(const std::vector<T> &values) {
+
+    double total = 0;
+
+    for (T value : values) {
+        total += value;
+    }
+
+    return total / values.size();
+}
+
+template<typename T>
+static double variance(const std::vector<T> &values, double average) {
+
+    double total = 0;
+
+    for (T value : values) {
+        total += std::pow(value - average, 2);
+    }
+
+    return total / (values.size() - 1);
+}
+
+/**
+ * Asymptotic distribution of the Kolmogorov-Smirnov statistic, with Stephens' correction for small samples.
+ *
+ * @return The probability of a statistic at least as large as d, for samples of size n and m
+ */
+static double kolmogorovPValue(double d, size_t n, size_t m) {
+
+    double en = std::sqrt((double) n * m / (n + m));
+
+    double lambda = (en + 0.12 + 0.11 / en) * d;
+
+    if (lambda < 0.2) {
+        return 1;
+    }
+
+    double sum = 0, sign = 1;
+
+    for (int k = 1; k <= 100; k++) {
+        double term = sign * std::exp(-2 * k * k * lambda * lambda);
+
+        sum += term;
+
+        if (std::fabs(term) < 1e-12) {
+            break;
+        }
+
+        sign = -sign;
+    }
+
+    return std::min(1.0, std::max(0.0, 2 * sum));
+}
+
+/**
+ * Two sample Kolmogorov-Smirnov test. Tied values are stepped over together, which makes
+ * the test conservative for discrete data such as the costs.
+ *
+ * @return The statistic and its p-value
+ */
+static std::tuple<double, double> kolmogorovSmirnov(std::vector<double> a, std::vector<double> b) {
+
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+
+    size_t i = 0, j = 0;
+
+    double d = 0;
+
+    while (i < a.size() && j < b.size()) {
+        double value = std::min(a[i], b[j]);
+
+        while (i < a.size() && a[i] == value) {
+            i++;
+        }
+
+        while (j < b.size() && b[j] == value) {
+            j++;
+        }
+
+        d = std::max(d, std::fabs((double) i / a.size() - (double) j / b.size()));
+    }
+
+    return std::make_tuple(d, kolmogorovPValue(d, a.size(), b.size()));
+}
+
+/**
+ * Chi-square test of homogeneity between two samples of a discrete value. Neighbouring values are
+ * pooled into bins of at least MIN_BIN_OBSERVATIONS, so that sparse tails don't dominate the statistic.
+ *
+ * @return The statistic and its p-value
+ */
+static std::tuple<double, double> chiSquare(const std::vector<int> &a, const std::vector<int> &b) {
+
+    std::map<int, std::tuple<long, long>> counts;
+
+    for (int value : a) {
+        std::get<0>(counts[value])++;
+    }
+
+    for (int value : b) {
+        std::get<1>(counts[value])++;
+    }
+
+    std::vector<std::tuple<long, long>> bins;
+
+    long binA = 0, binB = 0;
+
+    for (auto &it : counts) {
+        binA += std::get<0>(it.second);
+        binB += std::get<1>(it.second);
+
+        if (binA + binB >= MIN_BIN_OBSERVATIONS) {
+            bins.emplace_back(binA, binB);
+
+            binA = 0;
+            binB = 0;
+        }
+    }
+
+    //Whatever is left over goes into the last bin
+    if (binA + binB > 0) {
+        if (bins.empty()) {
+            bins.emplace_back(binA, binB);
+        } else {
+            std::get<0>(bins.back()) += binA;
+            std::get<1>(bins.back()) += binB;
+        }
+    }
+
+    if (bins.size() < 2) {
+        return std::make_tuple(0.0, 1.0);
+    }
+
+    double shareA = (double) a.size() / (a.size() + b.size()), shareB = 1 - shareA;
+
+    double statistic = 0;
+
+    for (auto &bin : bins) {
+        long total = std::get<0>(bin) + std::get<1>(bin);
+
+        double expectedA = total * shareA, expectedB = total * shareB;
+
+        statistic += std::pow(std::get<0>(bin) - expectedA, 2) / expectedA
+                     + std::pow(std::get<1>(bin) - expectedB, 2) / expectedB;
+    }
+
+    boost::math::chi_squared_distribution<double> dist(bins.size() - 1);
+
+    return std::make_tuple(statistic, boost::math::cdf(boost::math::complement(dist, statistic)));
+}
+
+template<typename T>
+static MetricComparison compareMetric(const std::string &name, const std::string &testName,
+                                      const std::vector<T> &reference, const std::vector<T> &candidate,
+                                      std::tuple<double, double> distributionTest,
+                                      double alpha, double meanMargin) {
+
+    double referenceMean = mean(reference), candidateMean = mean(candidate);
+
+    double referenceVariance = variance(reference, referenceMean);
+
+    double standardError = std::sqrt(referenceVariance / reference.size()
+                                     + variance(candidate, candidateMean) / candidate.size());
+
+    //Two one-sided tests: the (1 - 2 alpha) interval of the difference must lie within the tolerance
+    boost::math::normal_distribution<double> normal;
+
+    double z = boost::math::quantile(boost::math::complement(normal, alpha));
+
+    double differenceBound = std::fabs(candidateMean - referenceMean) + z * standardError;
+
+    //Relative to the spread of the observations rather than to the mean, so that the margin
+    //and the standard error shrink together as the observations grow
+    double tolerance = meanMargin * std::sqrt(referenceVariance);
+
+    double statistic, pValue;
+
+    std::tie(statistic, pValue) = distributionTest;
+
+    bool passed = differenceBound <= tolerance && pValue >= alpha;
+
+    return MetricComparison(name, testName, referenceMean, candidateMean, differenceBound, tolerance,
+                            statistic, pValue, passed);
+}
+
+static std::tuple<std::vector<std::tuple<double, double, int>>, double>
+runTimed(const SimulationEngine &engine, double compensation, double oc_probability,
+         int observations, int dayCount, long seed) {
+
+    auto timeStart = std::chrono::steady_clock::now();
+
+    auto result = engine(compensation, oc_probability, observations, dayCount, seed);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    double throughput = elapsed > 0 ? result.size() / elapsed : 0;
+
+    return std::make_tuple(std::move(result), throughput);
+}
+
+EquivalenceReport checkEquivalence(const SimulationEngine &reference, const SimulationEngine &candidate,
+                                   double compensation, double oc_probability, int observations, int dayCount,
+                                   long seed, double significance, double meanMargin) {
+
+    if (observations < 2) {
+        throw std::invalid_argument("The equivalence check needs at least 2 observations");
+    }
+
+    std::vector<std::tuple<double, double, int>> referenceData, candidateData;
+
+    double referenceThroughput, candidateThroughput;
+
+    std::tie(referenceData, referenceThroughput) = runTimed(reference, compensation, oc_probability,
+                                                            observations, dayCount, seed);
+
+    std::tie(candidateData, candidateThroughput) = runTimed(candidate, compensation, oc_probability,
+                                                            observations, dayCount, seed + 1);
+
+    if (referenceData.size() != (size_t) observations || candidateData.size() != (size_t) observations) {
+        throw std::runtime_error("An engine did not return the requested amount of observations");
+    }
+
+    std::vector<double> referenceComp, referencePF,
+            candidateComp, candidatePF;
+
+    std::vector<int> referenceMaxPackages, candidateMaxPackages;
+
+    for (auto &it : referenceData) {
+        referenceComp.push_back(std::get<0>(it));
+        referencePF.push_back(std::get<1>(it));
+        referenceMaxPackages.push_back(std::get<2>(it));
+    }
+
+    for (auto &it : candidateData) {
+        candidateComp.push_back(std::get<0>(it));
+        candidatePF.push_back(std::get<1>(it));
+        candidateMaxPackages.push_back(std::get<2>(it));
+    }
+
+    //3 metrics with a distribution test and a mean test each (Bonferroni correction)
+    double alpha = significance / 6;
+
+    std::vector<MetricComparison> metrics;
+
+    metrics.push_back(compareMetric("Compensation cost", "KS", referenceComp, candidateComp,
+                                    kolmogorovSmirnov(referenceComp, candidateComp), alpha, meanMargin));
+
+    metrics.push_back(compareMetric("Professional delivery cost", "KS", referencePF, candidatePF,
+                                    kolmogorovSmirnov(referencePF, candidatePF), alpha, meanMargin));
+
+    metrics.push_back(compareMetric("Max packages in lockers", "Chi-square", referenceMaxPackages,
+                                    candidateMaxPackages, chiSquare(referenceMaxPackages, candidateMaxPackages), alpha, meanMargin));
+
+    return EquivalenceReport(metrics, referenceThroughput, candidateThroughput);
+}
@@ -0,0 +1,139 @@
+#ifndef MADSIM_EQUIVALENCE_H
+#define MADSIM_EQUIVALENCE_H
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/*
+ * A way of running observations, returning for each one the cost of the compensations,
+ * the cost of the professional deliveries and the max amount of packages in the lockers,
+ * like ObservationHolder::runObservation. The same seed must always give the same observations.
+ */
+typedef std::function<std::vector<std::tuple<double, double, int>>(
+        double compensation, double oc_probability, int observations, int dayCount, long seed)> SimulationEngine;
+
+/**
+ * The reference engine: ObservationHolder::runObservation in a loop.
+ */
+std::vector<std::tuple<double, double, int>>
+referenceEngine(double compensation, double oc_probability, int observations, int dayCount, long seed);
+
+class MetricComparison {
+
+private:
+    std::string name, testName;
+
+    double referenceMean, candidateMean;
+
+    //Upper bound of |candidateMean - referenceMean| at the test's confidence
+    double meanDifferenceBound, tolerance;
+
+    double statistic, pValue;
+
+    bool passed;
+public:
+    MetricComparison(std::string name, std::string testName, double referenceMean, double candidateMean,
+                     double meanDifferenceBound, double tolerance, double statistic, double pValue, bool passed) :
+            name(std::move(name)), testName(std::move(testName)),
+            referenceMean(referenceMean), candidateMean(candidateMean),
+            meanDifferenceBound(meanDifferenceBound), tolerance(tolerance),
+            statistic(statistic), pValue(pValue), passed(passed) {}
+
+    const std::string &getName() const {
+        return name;
+    }
+
+    const std::string &getTestName() const {
+        return testName;
+    }
+
+    double getReferenceMean() const {
+        return referenceMean;
+    }
+
+    double getCandidateMean() const {
+        return candidateMean;
+    }
+
+    double getMeanDifferenceBound() const {
+        return meanDifferenceBound;
+    }
+
+    double getTolerance() const {
+        return tolerance;
+    }
+
+    double getStatistic() const {
+        return statistic;
+    }
+
+    double getPValue() const {
+        return pValue;
+    }
+
+    bool isPassed() const {
+        return passed;
+    }
+};
+
+class EquivalenceReport {
+
+private:
+    std::vector<MetricComparison> metrics;
+
+    //Observations per second
+    double referenceThroughput, candidateThroughput;
+public:
+    EquivalenceReport(std::vector<MetricComparison> metrics, double referenceThroughput, double candidateThroughput) :
+            metrics(std::move(metrics)), referenceThroughput(referenceThroughput),
+            candidateThroughput(candidateThroughput) {}
+
+    const std::vector<MetricComparison> &getMetrics() const {
+        return metrics;
+    }
+
+    double getReferenceThroughput() const {
+        return referenceThroughput;
+    }
+
+    double getCandidateThroughput() const {
+        return candidateThroughput;
+    }
+
+    bool isPassed() const {
+        for (auto &metric : metrics) {
+            if (!metric.isPassed()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+/**
+ * Runs both engines on the same scenario and checks that they simulate the same model.
+ *
+ * For the compensation and professional delivery costs the distributions are compared with a
+ * two sample Kolmogorov-Smirnov test, for the max packages in the lockers with a chi-square test.
+ * The means must also be proven equivalent (two one-sided tests): the difference must be within
+ * meanMargin standard deviations of the reference observations.
+ *
+ * Only the distribution tests reject equivalent engines with probability significance. The mean test
+ * also needs enough observations for its standard error to be small next to the margin: about
+ * (z + 3)^2 * 2 / meanMargin^2 observations, where z is the normal quantile of significance / 6.
+ *
+ * The reference runs with the given seed and the candidate with seed + 1, so the samples are independent.
+ *
+ * @param observations At least 2
+ * @param significance Split over the 6 tests made (Bonferroni correction)
+ * @param meanMargin Difference allowed between the means, in standard deviations of the reference
+ */
+EquivalenceReport checkEquivalence(const SimulationEngine &reference, const SimulationEngine &candidate,
+                                   double compensation, double oc_probability, int observations, int dayCount,
+                                   long seed, double significance, double meanMargin);
+
+#endif //MADSIM_EQUIVALENCE_H
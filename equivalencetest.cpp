@@ -0,0 +1,109 @@
+#include <iostream>
+#include <iomanip>
+#include <tuple>
+#include <vector>
+#include "equivalence.h"
+#include "simfuncs.h"
+
+/*
+ * Fixed scenario for the equivalence check. With these settings the mean test needs about
+ * 8200 observations to accept equivalent engines, see checkEquivalence.
+ */
+#define OBSERVATIONS 10000
+#define DAY_COUNT 30
+#define FIRST_SEED 42
+
+//Chance of failing equivalent engines, split over the scenarios
+#define SIGNIFICANCE 0.01
+
+//Difference allowed between the means, in standard deviations
+#define MEAN_MARGIN 0.1
+
+/**
+ * Checks a candidate engine against the reference on every default compensation.
+ *
+ * @return Whether the candidate passed on every scenario
+ */
+static bool checkEngineEquivalence(const SimulationEngine &candidate) {
+
+    bool passed = true;
+
+    long seed = FIRST_SEED;
+
+    for (auto &it : defaultCompensations) {
+
+        EquivalenceReport report = checkEquivalence(referenceEngine, candidate, std::get<0>(it), std::get<1>(it),
+                                                    OBSERVATIONS, DAY_COUNT, seed,
+                                                    SIGNIFICANCE / defaultCompensations.size(), MEAN_MARGIN);
+
+        std::cout << "EQUIVALENCE FOR " << std::get<0>(it) << "€ with probability " << std::get<1>(it) << ": "
+                  << (report.isPassed() ? "PASS" : "FAIL") << std::endl;
+
+        for (auto &metric : report.getMetrics()) {
+            std::cout << std::setprecision(5) << metric.getName() << ": "
+                      << "Reference mean: " << metric.getReferenceMean()
+                      << " | Candidate mean: " << metric.getCandidateMean()
+                      << " | Difference bound: " << metric.getMeanDifferenceBound()
+                      << " (tolerance " << metric.getTolerance() << ")"
+                      << " | " << metric.getTestName() << ": " << metric.getStatistic()
+                      << " (p = " << metric.getPValue() << ")"
+                      << (metric.isPassed() ? "" : " FAIL") << std::endl;
+        }
+
+        std::cout << "Throughput: Reference: " << report.getReferenceThroughput()
+                  << " observations/s | Candidate: " << report.getCandidateThroughput() << " observations/s"
+                  << std::endl;
+
+        passed = passed && report.isPassed();
+
+        seed += 2;
+    }
+
+    return passed;
+}
+
+/*
+ * New engines are checked by adding them here. Until an alternative engine exists the only real
+ * candidate is the reference itself, which checks that the harness accepts equivalent engines.
+ * The drifted engines are negative controls: the harness must reject them, or it can never fail.
+ */
+int main() {
+
+    std::vector<std::tuple<const char *, SimulationEngine, bool>> candidates = {
+            std::make_tuple("Reference", SimulationEngine(referenceEngine), true),
+            std::make_tuple("OC probability 5% higher (negative control)",
+                            SimulationEngine([](double compensation, double oc_probability, int observations,
+                                                int dayCount, long seed) {
+                                return referenceEngine(compensation, oc_probability * 1.05, observations,
+                                                       dayCount, seed);
+                            }), false),
+            std::make_tuple("One day less (negative control)",
+                            SimulationEngine([](double compensation, double oc_probability, int observations,
+                                                int dayCount, long seed) {
+                                return referenceEngine(compensation, oc_probability, observations,
+                                                       dayCount - 1, seed);
+                            }), false)
+    };
+
+    bool passed = true;
+
+    for (auto &it : candidates) {
+        std::cout << "CANDIDATE " << std::get<0>(it) << std::endl;
+
+        bool equivalent = checkEngineEquivalence(std::get<1>(it));
+
+        bool expected = std::get<2>(it);
+
+        if (equivalent != expected) {
+            std::cout << "UNEXPECTED: " << std::get<0>(it) << " was " << (equivalent ? "accepted" : "rejected")
+                      << std::endl;
+
+            passed = false;
+        }
+    }
+
+    std::cout << (passed ? "Every engine was accepted or rejected as expected" : "The equivalence check failed")
+              << std::endl;
+
+    return passed ? 0 : 1;
+}
@@ -3,14 +3,10 @@
 #include <tuple>
 #include <iomanip>
 #include <chrono>
+#include <thread>
+#include <stdexcept>
 #include "simfuncsasync.h"
 
-static std::vector<std::tuple<double, double>> defaultCompensations = {{0,   0.01},
-                                                                       {.5,  .25},
-                                                                       {1,   .5},
-                                                                       {1.5, .6},
-                                                                       {1.8, .75}};
-
 void runWithConfidence(int observations, int dayCount, double confidence, double compensation, double oc_probability) {
 
     std::unique_ptr<ObservationHolder> observation
@@ -46,10 +42,131 @@ void runWithConfidence(int observations, int dayCount, double confidence, double
     std::cout << "Total cost: " << std::endl << "Min: " << totalCostMin << " | Max: " << totalCostMax << std::endl;
 }
 
+void runWithProgress(int observations, int dayCount, double confidence, double compensation, double oc_probability,
+                     int timeLimitSeconds) {
+
+    AsyncObservation observation(compensation, oc_probability);
+
+    auto handle = observation.runSimulationAsync(observations, dayCount, confidence,
+                                                 std::chrono::milliseconds(500),
+                                                 [](const ProgressReport &report) {
+                                                     const Results &result = report.getResults();
+
+                                                     std::cout << std::setprecision(7)
+                                                               << (report.isFinal() ? "Final: " : "Progress: ")
+                                                               << report.getObservationsDone() << "/"
+                                                               << report.getObservationsTotal()
+                                                               << " | Total cost: " << result.getMeanTotal()
+                                                               << " +- " << result.getHalfWidthTotal()
+                                                               << " | " << report.getThroughput()
+                                                               << " observations/s" << std::endl;
+                                                 },
+                                                 std::chrono::seconds(timeLimitSeconds));
+
+    std::unique_ptr<Results> result;
+
+    try {
+        result.reset(new Results(handle->get()));
+    } catch (const std::runtime_error &error) {
+        std::cout << "No results for " << compensation << "€ with probability " << oc_probability << ": "
+                  << error.what() << std::endl;
+
+        return;
+    }
+
+    std::cout << "RESULTS FOR " << compensation << "€ with probability " << oc_probability << std::endl;
+
+    std::cout << "Total cost: " << std::endl << "Min: " << result->getMinTotal() << " | Max: " << result->getMaxTotal()
+              << std::endl;
+}
+
+long timeSimulation(AsyncObservation &observation, int observations, int dayCount, double confidence) {
+
+    auto timeStart = std::chrono::steady_clock::now();
+
+    observation.runSimulation(observations, dayCount, confidence);
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - timeStart).count();
+}
+
+struct PlacementTiming {
+    unsigned int threads;
+
+    long unpinnedMs, pinnedMs, pinnedNoSMTMs;
+
+    //Pinning never uses more workers than there are CPUs to pin them to
+    unsigned int pinnedWorkers, pinnedNoSMTWorkers;
+};
+
+/**
+ * Runs the same simulation with an increasing amount of threads, with and without
+ * pinning the threads to CPUs, to compare how both scale.
+ * Every variant summarizes the observations on its workers, so they only differ in their affinity.
+ */
+void benchmarkPlacement(int observations, int dayCount, double confidence, double compensation,
+                        double oc_probability) {
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    PlacementOptions unpinned, pinned, pinnedNoSMT;
+
+    pinned.pinThreads = true;
+
+    pinnedNoSMT.pinThreads = true;
+    pinnedNoSMT.skipSMTSiblings = true;
+
+    std::vector<PlacementTiming> timings;
+
+    for (unsigned int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+
+        AsyncObservation unpinnedObservation(compensation, oc_probability, threads, unpinned),
+                pinnedObservation(compensation, oc_probability, threads, pinned),
+                pinnedNoSMTObservation(compensation, oc_probability, threads, pinnedNoSMT);
+
+        PlacementTiming timing;
+
+        timing.threads = threads;
+
+        //Always timed in the same order, so warm up affects every row alike
+        timing.unpinnedMs = timeSimulation(unpinnedObservation, observations, dayCount, confidence);
+
+        timing.pinnedMs = timeSimulation(pinnedObservation, observations, dayCount, confidence);
+
+        timing.pinnedNoSMTMs = timeSimulation(pinnedNoSMTObservation, observations, dayCount, confidence);
+
+        timing.pinnedWorkers = pinnedObservation.getWorkerCount();
+
+        timing.pinnedNoSMTWorkers = pinnedNoSMTObservation.getWorkerCount();
+
+        timings.push_back(timing);
+
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+
+    long base = std::max(1L, timings[0].unpinnedMs);
+
+    std::cout << "Threads | Unpinned ms (speedup) | Pinned workers: ms (speedup) | Pinned, no SMT workers: ms (speedup)"
+              << std::endl;
+
+    for (auto &it : timings) {
+        std::cout << std::setprecision(3) << it.threads
+                  << " | " << it.unpinnedMs << " (" << (double) base / std::max(1L, it.unpinnedMs) << ")"
+                  << " | " << it.pinnedWorkers << ": " << it.pinnedMs
+                  << " (" << (double) base / std::max(1L, it.pinnedMs) << ")"
+                  << " | " << it.pinnedNoSMTWorkers << ": " << it.pinnedNoSMTMs
+                  << " (" << (double) base / std::max(1L, it.pinnedNoSMTMs) << ")"
+                  << std::endl;
+    }
+}
+
 void checkSimType(int observations, int dayCount, double confidence) {
 
     std::cout << "1) Use default compensation levels." << std::endl
-              << "2) Use custom compensation levels." << std::endl;
+              << "2) Use custom compensation levels." << std::endl
+              << "3) Use custom compensation levels with live progress." << std::endl
+              << "4) Benchmark thread placement." << std::endl;
 
     int choice;
 
@@ -80,6 +197,44 @@ void checkSimType(int observations, int dayCount, double confidence) {
 
             break;
         }
+        case 3: {
+
+            double compensation, compensationProbability;
+
+            int timeLimit;
+
+            std::cout << "Insert the compensation: " << std::endl;
+
+            std::cin >> compensation;
+
+            std::cout << "Insert the compensation probability: " << std::endl;
+
+            std::cin >> compensationProbability;
+
+            std::cout << "Insert the time limit in seconds (0 for no limit): " << std::endl;
+
+            std::cin >> timeLimit;
+
+            runWithProgress(observations, dayCount, confidence, compensation, compensationProbability, timeLimit);
+
+            break;
+        }
+        case 4: {
+
+            double compensation, compensationProbability;
+
+            std::cout << "Insert the compensation: " << std::endl;
+
+            std::cin >> compensation;
+
+            std::cout << "Insert the compensation probability: " << std::endl;
+
+            std::cin >> compensationProbability;
+
+            benchmarkPlacement(observations, dayCount, confidence, compensation, compensationProbability);
+
+            break;
+        }
         default:
             checkSimType(observations, dayCount, confidence);
             break;
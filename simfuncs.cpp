@@ -20,6 +20,12 @@
 
 using namespace std::chrono;
 
+const std::vector<std::tuple<double, double>> defaultCompensations = {{0,   0.01},
+                                                                      {.5,  .25},
+                                                                      {1,   .5},
+                                                                      {1.5, .6},
+                                                                      {1.8, .75}};
+
 ObservationHolder::ObservationHolder(double compensation, double oc_probability)
         : COMPENSATION(compensation),
           OC_PROBABILITY(oc_probability),
@@ -29,6 +35,15 @@ ObservationHolder::ObservationHolder(double compensation, double oc_probability)
 
 }
 
+ObservationHolder::ObservationHolder(double compensation, double oc_probability, long seed)
+        : COMPENSATION(compensation),
+          OC_PROBABILITY(oc_probability),
+          randBuffer() {
+
+    srand48_r(seed, &randBuffer);
+
+}
+
 class DayInfo {
 
 private:
@@ -350,6 +365,90 @@ Results doResults(const std::vector<double> &costsPF, const std::vector<double>
                    minPF, maxPF, minPackages, maxPackage, absMaxPackages};
 }
 
+ObservationStats::ObservationStats()
+        : count(0),
+          meanTotal(0), m2Total(0),
+          meanComp(0), m2Comp(0),
+          meanPF(0), m2PF(0),
+          meanPackages(0), m2Packages(0),
+          absMaxPackages(0) {}
+
+static void addToRunning(long count, double value, double &mean, double &m2) {
+    double delta = value - mean;
+
+    mean += delta / count;
+
+    m2 += delta * (value - mean);
+}
+
+static void mergeRunning(long count, long otherCount, double otherMean, double otherM2, double &mean, double &m2) {
+    long total = count + otherCount;
+
+    double delta = otherMean - mean;
+
+    mean += delta * otherCount / total;
+
+    m2 += otherM2 + delta * delta * ((double) count * otherCount / total);
+}
+
+void ObservationStats::add(double costComp, double costPF, int maxPackages) {
+    count++;
+
+    addToRunning(count, costPF + costComp, meanTotal, m2Total);
+    addToRunning(count, costComp, meanComp, m2Comp);
+    addToRunning(count, costPF, meanPF, m2PF);
+    addToRunning(count, maxPackages, meanPackages, m2Packages);
+
+    absMaxPackages = std::max(absMaxPackages, maxPackages);
+}
+
+void ObservationStats::merge(const ObservationStats &other) {
+    if (other.count == 0) {
+        return;
+    }
+
+    if (count == 0) {
+        *this = other;
+
+        return;
+    }
+
+    mergeRunning(count, other.count, other.meanTotal, other.m2Total, meanTotal, m2Total);
+    mergeRunning(count, other.count, other.meanComp, other.m2Comp, meanComp, m2Comp);
+    mergeRunning(count, other.count, other.meanPF, other.m2PF, meanPF, m2PF);
+    mergeRunning(count, other.count, other.meanPackages, other.m2Packages, meanPackages, m2Packages);
+
+    count += other.count;
+
+    absMaxPackages = std::max(absMaxPackages, other.absMaxPackages);
+}
+
+/**
+ * Same confidence intervals as doResults, calculated from the running statistics.
+ * Requires at least 2 observations.
+ */
+Results ObservationStats::toResults(double confidence) const {
+
+    boost::math::students_t_distribution<double> dist(count - 1);
+
+    double invAlpha = (1 - confidence) / 2;
+
+    double T = boost::math::quantile(boost::math::complement(dist, invAlpha));
+
+    double hTotal = T * sqrt(m2Total / (count - 1) / count);
+
+    double hComp = T * sqrt(m2Comp / (count - 1) / count);
+
+    double hPF = T * sqrt(m2PF / (count - 1) / count);
+
+    double hPackages = T * sqrt(m2Packages / (count - 1) / count);
+
+    return Results{meanTotal - hTotal, meanTotal + hTotal,
+                   meanComp - hComp, meanComp + hComp,
+                   meanPF - hPF, meanPF + hPF,
+                   meanPackages - hPackages, meanPackages + hPackages, absMaxPackages};
+}
+
 /**
  * Runs the simulation with the given parameters
  *
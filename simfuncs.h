@@ -4,6 +4,7 @@
 #include <tuple>
 #include <random>
 #include <utility>
+#include <vector>
 
 class DayInfo;
 
@@ -59,8 +60,73 @@ public:
         return maxPackageTotal;
     }
 
+    double getMeanTotal() const {
+        return (minTotal + maxTotal) / 2;
+    }
+
+    double getHalfWidthTotal() const {
+        return (maxTotal - minTotal) / 2;
+    }
+
+    double getMeanComp() const {
+        return (minComp + maxComp) / 2;
+    }
+
+    double getHalfWidthComp() const {
+        return (maxComp - minComp) / 2;
+    }
+
+    double getMeanPf() const {
+        return (minPF + maxPF) / 2;
+    }
+
+    double getHalfWidthPf() const {
+        return (maxPF - minPF) / 2;
+    }
+
+    double getMeanPackages() const {
+        return (minPackages + maxPackages) / 2;
+    }
+
+    double getHalfWidthPackages() const {
+        return (maxPackages - minPackages) / 2;
+    }
+
 };
 
+/*
+ * Running mean and variance of a set of observations (Welford's algorithm).
+ * Lets workers summarize their observations locally and merge the summaries later,
+ * without having to keep every observation around.
+ */
+class ObservationStats {
+
+private:
+    long count;
+
+    double meanTotal, m2Total,
+            meanComp, m2Comp,
+            meanPF, m2PF,
+            meanPackages, m2Packages;
+
+    int absMaxPackages;
+public:
+    ObservationStats();
+
+    void add(double costComp, double costPF, int maxPackages);
+
+    void merge(const ObservationStats &other);
+
+    long getCount() const {
+        return count;
+    }
+
+    Results toResults(double confidence) const;
+};
+
+//The compensations and their probabilities from the assignment
+extern const std::vector<std::tuple<double, double>> defaultCompensations;
+
 Results doResults(const std::vector<double> &costsPF, const std::vector<double> &costsComp,
                   const std::vector<int> &maxPackages, int observations, double confidence);
 
@@ -69,6 +135,9 @@ class ObservationHolder {
 public:
     ObservationHolder(double compensation, double oc_probability);
 
+    //Fixed seed, for reproducible observations
+    ObservationHolder(double compensation, double oc_probability, long seed);
+
     std::tuple<double, double, int> runObservation(int dayCount);
 
     virtual Results runSimulation(int observations, int dayCount, double confidence);
@@ -1,16 +1,103 @@
 #include "simfuncsasync.h"
 #include "simfuncs.h"
+#include <random>
+#include <stdexcept>
 #include <boost/math/distributions/students_t.hpp>
 
 #include "ctpl.h"
 
+//How many observations a worker runs before publishing them to the interim results
+#define PROGRESS_BATCH 64
+
+/*
+ * The share of a run given to one worker.
+ */
+struct WorkerAssignment {
+    int observationCount;
+
+    //CPU to pin the worker to, -1 to leave it unpinned
+    int cpu;
+
+    long seed;
+};
+
+/**
+ * Splits the observations over the workers, the last one taking any left over observations.
+ *
+ * @param cpus The CPU of each worker, empty if the workers are not pinned
+ */
+static std::vector<WorkerAssignment> assignWorkers(int observations, int workers, const std::vector<int> &cpus) {
+
+    std::vector<WorkerAssignment> assignments(workers);
+
+    int observationsPerThread = observations / workers;
+
+    //Workers started in the same second would otherwise all get the same time based seed
+    long baseSeed = std::random_device()();
+
+    for (int i = 0; i < workers; i++) {
+        assignments[i].observationCount = observationsPerThread + (i == workers - 1 ? observations % workers : 0);
+
+        assignments[i].cpu = cpus.empty() ? -1 : cpus[i];
+
+        assignments[i].seed = baseSeed + i;
+    }
+
+    return assignments;
+}
+
+/**
+ * Runs the observations of a worker, reducing them on the worker instead of returning each one.
+ * Their summary is handed to publish every batchSize observations and once more at the end.
+ *
+ * @param shouldStop Checked before every observation, to stop the worker early
+ */
+template<typename StopCheck, typename Publish>
+static void runWorkerObservations(double compensation, double oc_probability, int dayCount,
+                                  const WorkerAssignment &worker, int batchSize,
+                                  StopCheck shouldStop, Publish publish) {
+
+    if (worker.cpu >= 0 && !pinCurrentThread(worker.cpu)) {
+        throw std::runtime_error("Could not pin worker to CPU " + std::to_string(worker.cpu));
+    }
+
+    ObservationHolder holder(compensation, oc_probability, worker.seed);
+
+    ObservationStats batch;
+
+    for (int i = 0; i < worker.observationCount && !shouldStop(); i++) {
+
+        double observationCostCompensation, observationCostPF;
+
+        int maxPackagesInLockers;
+
+        std::tie(observationCostCompensation, observationCostPF, maxPackagesInLockers) = holder.runObservation(
+                dayCount);
+
+        batch.add(observationCostCompensation, observationCostPF, maxPackagesInLockers);
+
+        if (batch.getCount() == batchSize) {
+            publish(batch);
+
+            batch = ObservationStats();
+        }
+    }
+
+    publish(batch);
+}
+
 AsyncObservation::AsyncObservation(double compensation, double oc_prob) :
         ObservationHolder(compensation, oc_prob),
-        threadsToUse(std::thread::hardware_concurrency()) {}
+        threadsToUse(std::thread::hardware_concurrency()), placed(false) {}
 
 AsyncObservation::AsyncObservation(double compensation, double oc_prob, unsigned int threads) :
         ObservationHolder(compensation, oc_prob),
-        threadsToUse(threads) {}
+        threadsToUse(threads), placed(false) {}
+
+AsyncObservation::AsyncObservation(double compensation, double oc_prob, unsigned int threads,
+                                   PlacementOptions placement) :
+        ObservationHolder(compensation, oc_prob),
+        threadsToUse(threads), placement(placement), placed(true) {}
 
 std::unique_ptr<std::vector<std::tuple<double, double, int>>>
 AsyncObservation::runObservationAsync(int id, int observationCounts, int dayCount) {
@@ -30,8 +117,92 @@ AsyncObservation::runObservationAsync(int id, int observationCounts, int dayCoun
     return vector;
 }
 
+/**
+ * @return The CPU for each worker, empty if the workers should not be pinned.
+ * Never returns more CPUs than are available, so with pinning fewer workers may be used than requested.
+ */
+std::vector<int> AsyncObservation::selectWorkerCpus(const CpuTopology &topology) const {
+
+    if (!placement.pinThreads) {
+        return std::vector<int>();
+    }
+
+    std::vector<int> cpus = topology.selectCpus(placement.skipSMTSiblings);
+
+    if (cpus.size() > threadsToUse) {
+        cpus.resize(threadsToUse);
+    }
+
+    return cpus;
+}
+
+unsigned int AsyncObservation::getWorkerCount() const {
+
+    std::vector<int> cpus = selectWorkerCpus(CpuTopology::detect());
+
+    return cpus.empty() ? threadsToUse : (unsigned int) cpus.size();
+}
+
+Results AsyncObservation::runPlacedSimulation(int observations, int dayCount, double confidence) {
+
+    CpuTopology topology = CpuTopology::detect();
+
+    std::vector<int> cpus = selectWorkerCpus(topology);
+
+    int workers = cpus.empty() ? (int) threadsToUse : (int) cpus.size();
+
+    if (cpus.empty()) {
+        std::cout << "Running " << observations << " observations on " << workers << " unpinned threads"
+                  << std::endl;
+    } else {
+        std::cout << "Running " << observations << " observations on " << workers << " threads pinned over "
+                  << topology.getNodeCount() << " NUMA nodes" << std::endl;
+    }
+
+    ctpl::thread_pool threadPool(workers);
+
+    std::vector<std::future<ObservationStats>> results(workers);
+
+    std::vector<WorkerAssignment> assignments = assignWorkers(observations, workers, cpus);
+
+    for (int i = 0; i < workers; i++) {
+
+        WorkerAssignment worker = assignments[i];
+
+        results[i] = threadPool.push([this, worker, dayCount](int id) {
+            ObservationStats stats;
+
+            runWorkerObservations(COMPENSATION, OC_PROBABILITY, dayCount, worker, worker.observationCount,
+                                  []() { return false; },
+                                  [&stats](const ObservationStats &batch) { stats.merge(batch); });
+
+            return stats;
+        });
+    }
+
+    //Merged per node and then across nodes, so the reduction order doesn't depend on how the
+    //CPUs were interleaved. The merges all run on this thread, on a few numbers per worker.
+    std::vector<ObservationStats> nodeStats(topology.getNodeCount());
+
+    for (int i = 0; i < workers; i++) {
+        nodeStats[cpus.empty() ? 0 : topology.getNodeOf(cpus[i])].merge(results[i].get());
+    }
+
+    ObservationStats stats;
+
+    for (auto &node : nodeStats) {
+        stats.merge(node);
+    }
+
+    return stats.toResults(confidence);
+}
+
 Results AsyncObservation::runSimulation(int observations, int dayCount, double confidence) {
 
+    if (placed) {
+        return runPlacedSimulation(observations, dayCount, confidence);
+    }
+
     std::cout << "Running " << observations << " observations on " << threadsToUse << " threads" << std::endl;
 
     ctpl::thread_pool threadPool((int) threadsToUse);
@@ -96,4 +267,217 @@ Results AsyncObservation::runSimulation(int observations, int dayCount, double c
 
     return doResults(costPFData, costCompensationData, packagesInLockers, observations, confidence);
 
-}
\ No newline at end of file
+}
+
+std::unique_ptr<SimulationHandle>
+AsyncObservation::runSimulationAsync(int observations, int dayCount, double confidence,
+                                     std::chrono::milliseconds reportInterval,
+                                     std::function<void(const ProgressReport &)> onProgress,
+                                     std::chrono::milliseconds timeLimit) {
+
+    auto deadline = timeLimit == std::chrono::milliseconds::zero()
+                    ? std::chrono::steady_clock::time_point::max()
+                    : std::chrono::steady_clock::now() + timeLimit;
+
+    std::unique_ptr<SimulationHandle> handle(
+            new SimulationHandle(COMPENSATION, OC_PROBABILITY, observations, dayCount, confidence,
+                                 reportInterval, std::move(onProgress), deadline));
+
+    std::vector<int> cpus = selectWorkerCpus(CpuTopology::detect());
+
+    handle->start(cpus.empty() ? threadsToUse : (unsigned int) cpus.size(), cpus);
+
+    return handle;
+}
+
+SimulationHandle::SimulationHandle(double compensation, double oc_probability, int observations, int dayCount,
+                                   double confidence, std::chrono::milliseconds reportInterval,
+                                   std::function<void(const ProgressReport &)> onProgress,
+                                   std::chrono::steady_clock::time_point deadline) :
+        COMPENSATION(compensation), OC_PROBABILITY(oc_probability),
+        observations(observations), dayCount(dayCount), confidence(confidence),
+        reportInterval(reportInterval), onProgress(std::move(onProgress)),
+        startTime(std::chrono::steady_clock::now()), deadline(deadline),
+        cancelled(false), workersRunning(0), done(false) {}
+
+SimulationHandle::~SimulationHandle() {
+    cancel();
+
+    if (coordinator.joinable()) {
+        coordinator.join();
+    }
+}
+
+void SimulationHandle::start(unsigned int threads, std::vector<int> cpus) {
+    workersRunning = (int) threads;
+
+    workerCpus = std::move(cpus);
+
+    coordinator = std::thread([this, threads]() {
+        this->coordinate(threads);
+    });
+}
+
+void SimulationHandle::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool SimulationHandle::isDone() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return done;
+}
+
+long SimulationHandle::getObservationsDone() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return stats.getCount();
+}
+
+Results SimulationHandle::get() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    stateChanged.wait(lock, [this]() { return done; });
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    if (!finalResults) {
+        throw std::runtime_error("Simulation stopped before 2 observations were done");
+    }
+
+    return *finalResults;
+}
+
+bool SimulationHandle::shouldStop() const {
+    return cancelled.load(std::memory_order_relaxed) || std::chrono::steady_clock::now() >= deadline;
+}
+
+void SimulationHandle::publish(const ObservationStats &batch) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stats.merge(batch);
+}
+
+void SimulationHandle::workerStopped() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    workersRunning--;
+
+    stateChanged.notify_all();
+}
+
+ProgressReport SimulationHandle::makeReport(bool finalReport) const {
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    double throughput = elapsed > 0 ? stats.getCount() / elapsed : 0;
+
+    return ProgressReport(stats.toResults(confidence), stats.getCount(), observations, throughput, finalReport);
+}
+
+/**
+ * Runs on the coordinator thread: hands the observations to the thread pool, reports the interim
+ * results every interval and stores the final results once all the workers have stopped.
+ */
+void SimulationHandle::coordinate(unsigned int threads) {
+
+    ctpl::thread_pool threadPool((int) threads);
+
+    std::vector<std::future<void>> workers(threads);
+
+    std::vector<WorkerAssignment> assignments = assignWorkers(observations, (int) threads, workerCpus);
+
+    for (int i = 0; i < threads; i++) {
+
+        WorkerAssignment worker = assignments[i];
+
+        workers[i] = threadPool.push([this, worker](int id) {
+            try {
+                runWorkerObservations(this->COMPENSATION, this->OC_PROBABILITY, this->dayCount, worker,
+                                      PROGRESS_BATCH,
+                                      [this]() { return this->shouldStop(); },
+                                      [this](const ObservationStats &batch) { this->publish(batch); });
+            } catch (...) {
+                //Stop the other workers, the error is reported by get()
+                this->cancel();
+
+                this->workerStopped();
+
+                throw;
+            }
+
+            this->workerStopped();
+        });
+    }
+
+    //A throwing callback cancels the simulation, the exception is rethrown by get()
+    std::exception_ptr callbackError;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stateChanged.wait_for(lock, reportInterval, [this]() { return workersRunning == 0; })) {
+
+        if (!onProgress || callbackError || stats.getCount() < 2) {
+            continue;
+        }
+
+        ProgressReport report = makeReport(false);
+
+        lock.unlock();
+
+        try {
+            onProgress(report);
+        } catch (...) {
+            callbackError = std::current_exception();
+
+            cancel();
+        }
+
+        lock.lock();
+    }
+
+    lock.unlock();
+
+    std::exception_ptr workerError;
+
+    for (auto &worker : workers) {
+        try {
+            worker.get();
+        } catch (...) {
+            workerError = std::current_exception();
+        }
+    }
+
+    lock.lock();
+
+    std::unique_ptr<ProgressReport> report;
+
+    if (!workerError && !callbackError && stats.getCount() >= 2) {
+        report.reset(new ProgressReport(makeReport(true)));
+    }
+
+    lock.unlock();
+
+    //Deliver the final report before get() returns, so callers never miss it
+    if (report && onProgress) {
+        try {
+            onProgress(*report);
+        } catch (...) {
+            callbackError = std::current_exception();
+        }
+    }
+
+    lock.lock();
+
+    if (report) {
+        finalResults.reset(new Results(report->getResults()));
+    }
+
+    error = workerError ? workerError : callbackError;
+
+    done = true;
+
+    stateChanged.notify_all();
+}
@@ -4,7 +4,144 @@
 #include <tuple>
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include "simfuncs.h"
+#include "cpuplacement.h"
+
+class ProgressReport {
+
+private:
+    Results results;
+
+    long observationsDone;
+
+    int observationsTotal;
+
+    double throughput;
+
+    bool finalReport;
+public:
+    ProgressReport(const Results &results, long observationsDone, int observationsTotal,
+                   double throughput, bool finalReport) :
+            results(results), observationsDone(observationsDone), observationsTotal(observationsTotal),
+            throughput(throughput), finalReport(finalReport) {}
+
+    const Results &getResults() const {
+        return results;
+    }
+
+    long getObservationsDone() const {
+        return observationsDone;
+    }
+
+    int getObservationsTotal() const {
+        return observationsTotal;
+    }
+
+    /**
+     * @return Observations completed per second since the simulation started
+     */
+    double getThroughput() const {
+        return throughput;
+    }
+
+    bool isFinal() const {
+        return finalReport;
+    }
+};
+
+/*
+ * Handle to a simulation running in the background, returned by AsyncObservation::runSimulationAsync.
+ *
+ * Destroying the handle cancels the simulation and waits for the workers to stop.
+ */
+class SimulationHandle {
+
+public:
+    ~SimulationHandle();
+
+    SimulationHandle(const SimulationHandle &) = delete;
+
+    SimulationHandle &operator=(const SimulationHandle &) = delete;
+
+    /**
+     * Asks the workers to stop. The observations already done are kept, so the final result
+     * is still available through get().
+     */
+    void cancel();
+
+    bool isDone();
+
+    long getObservationsDone();
+
+    /**
+     * Blocks until the simulation completes, is cancelled or reaches its deadline.
+     * Rethrows any exception thrown by a worker or by the progress callback.
+     *
+     * @return The results of every observation that was completed
+     */
+    Results get();
+
+private:
+    friend class AsyncObservation;
+
+    SimulationHandle(double compensation, double oc_probability, int observations, int dayCount, double confidence,
+                     std::chrono::milliseconds reportInterval,
+                     std::function<void(const ProgressReport &)> onProgress,
+                     std::chrono::steady_clock::time_point deadline);
+
+    const double COMPENSATION, OC_PROBABILITY;
+
+    const int observations, dayCount;
+
+    const double confidence;
+
+    const std::chrono::milliseconds reportInterval;
+
+    const std::function<void(const ProgressReport &)> onProgress;
+
+    const std::chrono::steady_clock::time_point startTime, deadline;
+
+    std::atomic<bool> cancelled;
+
+    std::mutex mutex;
+
+    std::condition_variable stateChanged;
+
+    //Guarded by mutex
+    ObservationStats stats;
+
+    int workersRunning;
+
+    bool done;
+
+    std::unique_ptr<Results> finalResults;
+
+    std::exception_ptr error;
+
+    std::thread coordinator;
+
+    //CPU each worker is pinned to, empty when the workers aren't pinned
+    std::vector<int> workerCpus;
+
+    void start(unsigned int threads, std::vector<int> cpus);
+
+    void coordinate(unsigned int threads);
+
+    bool shouldStop() const;
+
+    void publish(const ObservationStats &batch);
+
+    void workerStopped();
+
+    ProgressReport makeReport(bool finalReport) const;
+};
 
 class AsyncObservation : public ObservationHolder {
 
@@ -13,13 +150,48 @@ public:
 
     AsyncObservation(double, double, unsigned int);
 
+    /*
+     * With placement options each worker summarizes its own observations instead of returning
+     * each one, and the summaries are merged on the calling thread. The workers are only pinned when placement.pinThreads is set, so pinned
+     * and unpinned runs differ in nothing but their affinity.
+     */
+    AsyncObservation(double, double, unsigned int, PlacementOptions);
+
     Results runSimulation(int observations, int dayCount, double confidence) override;
 
+    /**
+     * @return The amount of workers a simulation will use, which can be less than requested when pinning
+     */
+    unsigned int getWorkerCount() const;
+
+    /**
+     * Runs the simulation in the background and returns immediately.
+     *
+     * @param reportInterval How often onProgress is called with the interim results
+     * @param onProgress Called from a background thread, once per interval and once more with the final results.
+     *                   Interim reports are only made once at least 2 observations are done.
+     *                   If it throws, the simulation is cancelled and get() rethrows the exception.
+     * @param timeLimit Stop after this long, keeping the observations done so far. Zero runs until completion.
+     */
+    std::unique_ptr<SimulationHandle> runSimulationAsync(int observations, int dayCount, double confidence,
+                                                         std::chrono::milliseconds reportInterval,
+                                                         std::function<void(const ProgressReport &)> onProgress,
+                                                         std::chrono::milliseconds timeLimit
+                                                         = std::chrono::milliseconds::zero());
+
 private:
     unsigned int threadsToUse;
 
+    PlacementOptions placement;
+
+    bool placed;
+
     std::unique_ptr<std::vector<std::tuple<double, double, int>>>
         runObservationAsync(int id, int observationCounts, int dayCount);
+
+    std::vector<int> selectWorkerCpus(const CpuTopology &topology) const;
+
+    Results runPlacedSimulation(int observations, int dayCount, double confidence);
 };
 
 